@@ -1,4 +1,5 @@
 #include <SDL2/SDL_assert.h>
+#include <SDL2/SDL_atomic.h>
 #include <SDL2/SDL_events.h>
 #include <SDL2/SDL_keyboard.h>
 #include <SDL2/SDL_pixels.h>
@@ -6,12 +7,15 @@
 #include <SDL2/SDL_scancode.h>
 #include <SDL2/SDL_stdinc.h>
 #include <SDL2/SDL_surface.h>
+#include <SDL2/SDL_thread.h>
 #include <SDL2/SDL_timer.h>
 #include <SDL2/SDL_video.h>
 #include <stdio.h>
 #include <SDL2/SDL.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <tinyfiledialogs.h>
 
 // display
@@ -74,6 +78,14 @@ SDL_Scancode keypad_map[] = {
     SDL_SCANCODE_Z, SDL_SCANCODE_X, SDL_SCANCODE_C, SDL_SCANCODE_V
 };
 
+// chip-8 key for each keypad_map entry
+const unsigned char KEYPAD_KEYS[] = {
+    0x1, 0x2, 0x3, 0xC,
+    0x4, 0x5, 0x6, 0xD,
+    0x7, 0x8, 0x9, 0xE,
+    0xA, 0x0, 0xB, 0xF
+};
+
 // SDL
 SDL_Window* window;
 SDL_Renderer* renderer;
@@ -84,6 +96,134 @@ bool debug_info_on = false;
 
 bool modern_flag = true;
 
+// debugger
+#define BREAK_EXEC 0x1
+#define WATCH_READ 0x2
+#define WATCH_WRITE 0x4
+#define MAX_GLOBAL_CONDITIONS 8
+
+typedef enum {
+    COND_ALWAYS,
+    COND_REGISTER,     // VX == NN
+    COND_DELAY_TIMER,  // DT == NN
+    COND_INDEX_RANGE   // I in LO-HI
+} condition_kind;
+
+typedef struct {
+    condition_kind kind;
+    bool negate;
+    unsigned char reg;
+    unsigned short lo;
+    unsigned short hi;
+    bool was_true; // global conditions only break on a false -> true edge
+} condition;
+
+unsigned char debug_flags[MEMORY_SIZE]; // per-address BREAK_EXEC / WATCH_* bits
+condition break_conditions[MEMORY_SIZE]; // optional condition per exec breakpoint
+condition global_conditions[MAX_GLOBAL_CONDITIONS];
+size_t global_condition_count = 0;
+size_t watchpoint_count = 0; // memory opcodes skip the watch lookup while this is 0
+
+bool break_pending = false;
+bool resume_past_break = false;
+bool console_step = false; // reopen the console after the next instruction
+
+// input latency
+#define LATENCY_BUCKETS 100 // 1 ms buckets, the last one collects everything slower
+
+typedef enum {
+    LATENCY_IDLE,
+    LATENCY_EVENT,     // key event received, waiting for EX9E/EXA1/FX0A to see it
+    LATENCY_OBSERVED,  // waiting for the framebuffer to change
+    LATENCY_CHANGED    // waiting for SDL_RenderPresent
+} latency_stage;
+
+const char* LATENCY_STAGE_NAMES[] = {"event -> observed", "event -> changed", "event -> presented"};
+
+bool latency_tracking_on = false;
+latency_stage latency_state = LATENCY_IDLE;
+unsigned char latency_key;
+Uint64 latency_times[4]; // performance counter per stage
+unsigned int latency_histogram[3][LATENCY_BUCKETS];
+double latency_max[3];
+
+// recorder
+#define RECORDER_QUEUE_SIZE 256 // power of two
+#define PACKED_DISPLAY_SIZE (DISPLAY_WIDTH * DISPLAY_HEIGHT / 8)
+
+typedef enum {
+    RECORD_FRAME,
+    RECORD_BEEP_ON,
+    RECORD_BEEP_OFF
+} record_type;
+
+typedef struct {
+    unsigned char type;
+    Uint32 time; // ms since recording started
+    unsigned char pixels[PACKED_DISPLAY_SIZE]; // 1 bit per pixel, frames only
+} record_entry;
+
+// single producer (emulator loop), single consumer (writer thread)
+record_entry recorder_queue[RECORDER_QUEUE_SIZE];
+SDL_atomic_t recorder_head;
+SDL_atomic_t recorder_tail;
+SDL_atomic_t recorder_stopping;
+
+SDL_Thread* recorder_thread = NULL;
+FILE* recorder_file;
+Uint64 recorder_start_time;
+unsigned int recorder_dropped = 0;
+bool recorder_beeping = false;
+
+// superinstructions
+#define MAX_FUSED_SPAN 6 // bytes covered by the longest fused sequence
+
+typedef enum {
+    FUSED_NONE,
+    FUSED_TIMER_WAIT,  // FX07; 3XNN/4XNN; 1NNN
+    FUSED_SPRITE,      // ANNN; DXYN
+    FUSED_SET_PAIR,    // 6XNN; 6YNN
+    FUSED_BCD_LOAD     // FX33; FY65
+} fused_kind;
+
+unsigned char fused_ops[MEMORY_SIZE]; // fused_kind starting at each address
+bool fusion_on = true;
+unsigned char pending_cycles = 0; // processor slots already used by a fused sequence
+
+// metrics
+#define METRICS_INTERVAL 1000 // ms between samples
+#define OVERLAY_PIXEL 3
+
+typedef struct {
+    Uint64 instructions;
+    Uint64 frames_presented;
+    Uint64 frames_dropped;  // 60hz ticks lost to a late main loop
+    Uint64 timer_ticks;
+    Uint64 key_wait_ms;     // time spent blocked in FX0A
+    Uint64 draws;
+    unsigned int draws_this_frame;
+    unsigned int draws_per_frame_max;
+} runtime_metrics;
+
+runtime_metrics metrics;
+runtime_metrics metrics_previous; // counters at the last sample
+Uint64 metrics_start;
+Uint64 metrics_sample_time;
+Uint64 key_wait_start;
+bool key_waiting = false;
+bool loop_stalled = false; // the 60hz tick after a stall is not counted as dropped
+
+// per-second rates from the last sample
+double sample_ips = 0;
+double sample_fps = 0;
+double sample_dropped = 0;
+unsigned int sample_draws_max = 0;
+double sample_drift = 0;     // timer ticks ahead (+) or behind (-) TIMER_FREQ
+double sample_key_wait = 0;  // ms per second blocked in FX0A
+
+bool overlay_on = false;
+const char* metrics_path = NULL; // from CHIP8_METRICS_FILE
+
 // font
 #define FONT_START_OFFSET 0
 #define FONT_HEIGHT 5
@@ -172,16 +312,50 @@ void load_font() {
     }
 }
 
-void clear_display(void) {
+fused_kind detect_fusion(unsigned short address) {
+    if (address + 4 > MEMORY_SIZE) { return FUSED_NONE; }
+
+    unsigned char op1 = memory[address] >> 4;
+    unsigned char x = memory[address] & 0xF;
+    unsigned char byte2 = memory[address+1];
+    unsigned char op2 = memory[address+2] >> 4;
+    unsigned char byte4 = memory[address+3];
+
+    if (op1 == 0xF && byte2 == 0x07 && (op2 == 0x3 || op2 == 0x4) && (memory[address+2] & 0xF) == x
+            && address + 6 <= MEMORY_SIZE && (memory[address+4] >> 4) == 0x1) {
+        return FUSED_TIMER_WAIT;
+    }
+    if (op1 == 0xA && op2 == 0xD) { return FUSED_SPRITE; }
+    if (op1 == 0x6 && op2 == 0x6) { return FUSED_SET_PAIR; }
+    if (op1 == 0xF && byte2 == 0x33 && op2 == 0xF && byte4 == 0x65) { return FUSED_BCD_LOAD; }
+
+    return FUSED_NONE;
+}
+
+void refuse_range(size_t address, size_t length) {
+    // re-detect every sequence that overlaps bytes written at runtime
+    size_t start = address >= MAX_FUSED_SPAN - 1 ? address - (MAX_FUSED_SPAN - 1) : 0;
+    size_t end = address + length < MEMORY_SIZE ? address + length : MEMORY_SIZE;
+
+    for (size_t i = start; i < end; i++) {
+        fused_ops[i] = detect_fusion(i);
+    }
+}
+
+bool clear_display(void) {
+    // returns whether any pixel was turned off
     if (debug_info_on) {
         puts("Clearing display.");
     }
 
+    bool changed = false;
     for (size_t row = 0; row < DISPLAY_HEIGHT; row++) {
         for (size_t col = 0; col < DISPLAY_WIDTH; col++) {
+            changed |= display[row][col];
             display[row][col] = 0;
         }
     }
+    return changed;
 }
 
 void reset() {
@@ -223,6 +397,13 @@ void reset() {
 
     // load font
     load_font();
+
+    // find fusable sequences
+    refuse_range(0, MEMORY_SIZE);
+    pending_cycles = 0;
+
+    // an FX0A wait from the previous ROM is abandoned
+    key_waiting = false;
 }
 
 void initialize(void) {
@@ -242,6 +423,11 @@ void initialize(void) {
         dispose();
         exit(1);
     }
+
+    // initialize metrics
+    metrics_path = getenv("CHIP8_METRICS_FILE");
+    metrics_start = SDL_GetTicks64();
+    metrics_sample_time = metrics_start;
 }
 
 void draw_pixel(size_t x, size_t y, SDL_Color color) {
@@ -268,6 +454,222 @@ void DEBUG_display() {
     }
 }
 
+double latency_ms(Uint64 start, Uint64 end) {
+    return (double)(end - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+void latency_key_event(unsigned char key) {
+    // one sample in flight at a time; a press that has not yet changed the
+    // framebuffer is replaced, so a read without a redraw cannot block sampling
+    if (!latency_tracking_on || latency_state > LATENCY_OBSERVED) { return; }
+
+    latency_key = key;
+    latency_times[LATENCY_EVENT] = SDL_GetPerformanceCounter();
+    latency_state = LATENCY_EVENT;
+}
+
+void latency_advance(latency_stage stage) {
+    latency_times[stage] = SDL_GetPerformanceCounter();
+    latency_state = stage;
+}
+
+void latency_frame_changed(void) {
+    if (latency_state != LATENCY_OBSERVED) { return; }
+
+    // a change long after the key was read is unrelated to it, drop the sample
+    if (latency_ms(latency_times[LATENCY_EVENT], SDL_GetPerformanceCounter()) >= LATENCY_BUCKETS) {
+        latency_state = LATENCY_IDLE;
+        return;
+    }
+    latency_advance(LATENCY_CHANGED);
+}
+
+void latency_record_present(void) {
+    Uint64 presented = SDL_GetPerformanceCounter();
+    Uint64 ends[] = {latency_times[LATENCY_OBSERVED], latency_times[LATENCY_CHANGED], presented};
+
+    for (size_t i = 0; i < 3; i++) {
+        double ms = latency_ms(latency_times[LATENCY_EVENT], ends[i]);
+        size_t bucket = ms < LATENCY_BUCKETS - 1 ? (size_t)ms : LATENCY_BUCKETS - 1;
+
+        latency_histogram[i][bucket]++;
+        if (ms > latency_max[i]) { latency_max[i] = ms; }
+    }
+    latency_state = LATENCY_IDLE;
+}
+
+void print_latency_report(void) {
+    const double PERCENTILES[] = {0.5, 0.9, 0.99};
+
+    puts("Input latency (upper bound of 1 ms bucket):");
+    for (size_t i = 0; i < 3; i++) {
+        unsigned int total = 0;
+        for (size_t bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+            total += latency_histogram[i][bucket];
+        }
+
+        printf("  %-20s n=%u", LATENCY_STAGE_NAMES[i], total);
+        if (total == 0) {
+            printf("\n");
+            continue;
+        }
+
+        for (size_t p = 0; p < 3; p++) {
+            unsigned int seen = 0;
+            size_t bucket = 0;
+            for (; bucket < LATENCY_BUCKETS - 1; bucket++) {
+                seen += latency_histogram[i][bucket];
+                if (seen >= PERCENTILES[p] * total) { break; }
+            }
+            printf(" p%g<=%zums", PERCENTILES[p] * 100, bucket + 1);
+        }
+        printf(" max=%.2fms\n", latency_max[i]);
+    }
+}
+
+void recorder_push(record_type type) {
+    // never blocks: when the writer falls behind the entry is dropped
+    int head = SDL_AtomicGet(&recorder_head);
+    if (head - SDL_AtomicGet(&recorder_tail) == RECORDER_QUEUE_SIZE) {
+        recorder_dropped++;
+        return;
+    }
+
+    record_entry* entry = &recorder_queue[head & (RECORDER_QUEUE_SIZE-1)];
+    entry->type = type;
+    entry->time = SDL_GetTicks64() - recorder_start_time;
+
+    if (type == RECORD_FRAME) {
+        memset(entry->pixels, 0, sizeof(entry->pixels));
+        for (size_t row = 0; row < DISPLAY_HEIGHT; row++) {
+            for (size_t col = 0; col < DISPLAY_WIDTH; col++) {
+                size_t bit = row * DISPLAY_WIDTH + col;
+                entry->pixels[bit / 8] |= display[row][col] << (7 - bit % 8);
+            }
+        }
+    }
+
+    SDL_AtomicSet(&recorder_head, head + 1);
+}
+
+void write_record(const record_entry* entry, unsigned char* previous) {
+    // record: type, u32 LE time, and for frames a u16 LE length followed by
+    // (count, byte) runs of the frame XORed with the previous one
+    unsigned char header[] = {
+        entry->type,
+        entry->time & 0xFF, (entry->time >> 8) & 0xFF,
+        (entry->time >> 16) & 0xFF, (entry->time >> 24) & 0xFF
+    };
+    fwrite(header, sizeof(header), 1, recorder_file);
+
+    if (entry->type != RECORD_FRAME) { return; }
+
+    unsigned char runs[PACKED_DISPLAY_SIZE * 2];
+    size_t length = 0;
+    for (size_t i = 0; i < PACKED_DISPLAY_SIZE;) {
+        unsigned char value = entry->pixels[i] ^ previous[i];
+        unsigned char count = 0;
+        while (i < PACKED_DISPLAY_SIZE && count < 255 && (entry->pixels[i] ^ previous[i]) == value) {
+            count++;
+            i++;
+        }
+        runs[length++] = count;
+        runs[length++] = value;
+    }
+
+    unsigned char length_bytes[] = {length & 0xFF, length >> 8};
+    fwrite(length_bytes, sizeof(length_bytes), 1, recorder_file);
+    fwrite(runs, length, 1, recorder_file);
+
+    memcpy(previous, entry->pixels, PACKED_DISPLAY_SIZE);
+}
+
+int recorder_writer(void* data) {
+    (void)data;
+    unsigned char previous[PACKED_DISPLAY_SIZE] = {0};
+
+    while (true) {
+        // read the stop flag first so no entry pushed before it is missed
+        bool stopping = SDL_AtomicGet(&recorder_stopping);
+        int tail = SDL_AtomicGet(&recorder_tail);
+
+        if (tail == SDL_AtomicGet(&recorder_head)) {
+            if (stopping) { break; }
+            SDL_Delay(5);
+            continue;
+        }
+
+        write_record(&recorder_queue[tail & (RECORDER_QUEUE_SIZE-1)], previous);
+        SDL_AtomicSet(&recorder_tail, tail + 1);
+    }
+    return 0;
+}
+
+void stop_recording(void) {
+    SDL_AtomicSet(&recorder_stopping, 1);
+    SDL_WaitThread(recorder_thread, NULL);
+    recorder_thread = NULL;
+
+    fclose(recorder_file);
+    printf("Recording stopped, %u entries dropped.\n", recorder_dropped);
+}
+
+void stop_recording_at_exit(void) {
+    // exit() paths (dialog cancel, stack errors) must not lose queued entries
+    if (recorder_thread != NULL) { stop_recording(); }
+}
+
+void start_recording(void) {
+    static bool exit_handler_registered = false;
+    if (!exit_handler_registered) {
+        atexit(stop_recording_at_exit);
+        exit_handler_registered = true;
+    }
+
+    // never overwrite an earlier recording, e.g. two started within one second
+    char path[64];
+    long now = (long)time(NULL);
+    for (unsigned int sequence = 0; ; sequence++) {
+        if (sequence == 0) {
+            snprintf(path, sizeof(path), "chip8-%ld.c8rec", now);
+        } else {
+            snprintf(path, sizeof(path), "chip8-%ld-%u.c8rec", now, sequence);
+        }
+
+        FILE* existing = fopen(path, "rb");
+        if (existing == NULL) { break; }
+        fclose(existing);
+    }
+
+    recorder_file = fopen(path, "wb");
+    if (recorder_file == NULL) {
+        printf("Error: failed to open %s for recording.\n", path);
+        return;
+    }
+
+    // header: magic, version, display size
+    const unsigned char header[] = {'C', 'H', '8', 'R', 'E', 'C', 1, DISPLAY_WIDTH, DISPLAY_HEIGHT};
+    fwrite(header, sizeof(header), 1, recorder_file);
+
+    SDL_AtomicSet(&recorder_head, 0);
+    SDL_AtomicSet(&recorder_tail, 0);
+    SDL_AtomicSet(&recorder_stopping, 0);
+    recorder_start_time = SDL_GetTicks64();
+    recorder_dropped = 0;
+    recorder_beeping = sound_timer > 0;
+
+    recorder_push(RECORD_FRAME);
+    if (recorder_beeping) { recorder_push(RECORD_BEEP_ON); }
+
+    recorder_thread = SDL_CreateThread(recorder_writer, "recorder", NULL);
+    if (recorder_thread == NULL) {
+        printf("Error: failed to start recorder. SDL_Error: %s\n", SDL_GetError());
+        fclose(recorder_file);
+        return;
+    }
+    printf("Recording to %s\n", path);
+}
+
 void draw_sprite(unsigned char x, unsigned char y, unsigned char n) {
     // sprites are 8-bit bytes from starting at I
 
@@ -277,6 +679,7 @@ void draw_sprite(unsigned char x, unsigned char y, unsigned char n) {
     }
 
     registers[0xF] = 0;
+    bool changed = false;
 
     for (int i = 0; i < n; i++) {
         if (y + i >= DISPLAY_HEIGHT) { break; }
@@ -294,15 +697,67 @@ void draw_sprite(unsigned char x, unsigned char y, unsigned char n) {
             
             // 0 - transparent, 1 - flip
             display[y+i][x+j] ^= bit;
+            changed |= bit;
         }
     }
+
+    if (changed) { latency_frame_changed(); }
 }
 
-void show_display(void) {
-    if (debug_info_on) {
-        puts("Updating display.");
+void draw_overlay_text(int x, int y, const char* text) {
+    // hex digits from the built-in font, '-' as a bar, anything else as a gap
+    SDL_SetRenderDrawColor(renderer, ON_COLOR.r, ON_COLOR.g, ON_COLOR.b, ON_COLOR.a);
+    for (int c = 0; text[c] != '\0'; c++) {
+        int left = x + c * 5 * OVERLAY_PIXEL;
+
+        if (text[c] == '-') {
+            SDL_Rect bar = {left, y + 2 * OVERLAY_PIXEL, 4 * OVERLAY_PIXEL, OVERLAY_PIXEL};
+            SDL_RenderFillRect(renderer, &bar);
+            continue;
+        }
+
+        int digit;
+        if (text[c] >= '0' && text[c] <= '9') { digit = text[c] - '0'; }
+        else if (text[c] >= 'A' && text[c] <= 'F') { digit = text[c] - 'A' + 10; }
+        else { continue; }
+
+        const unsigned char* glyph = &FONT[digit * FONT_HEIGHT];
+        for (int row = 0; row < FONT_HEIGHT; row++) {
+            for (int col = 0; col < 4; col++) {
+                if (!((glyph[row] >> (7 - col)) & 1)) { continue; }
+
+                SDL_Rect rect = {left + col * OVERLAY_PIXEL, y + row * OVERLAY_PIXEL, OVERLAY_PIXEL, OVERLAY_PIXEL};
+                SDL_RenderFillRect(renderer, &rect);
+            }
+        }
+    }
+}
+
+void draw_overlay(void) {
+    // each row is a hex-glyph tag followed by its value:
+    // C  instructions/s as % of PROCESSOR_FREQ    F  frames presented/s
+    // FD frames dropped/s                         D  most DXYN in one frame
+    // E  timer drift in ticks                     A  ms/s blocked in FX0A
+    const char* tags[] = {"C", "F", "FD", "D", "E", "A"};
+    const long values[] = {
+        (long)(sample_ips * 100 / PROCESSOR_FREQ), (long)sample_fps, (long)sample_dropped,
+        sample_draws_max, (long)sample_drift, (long)sample_key_wait
+    };
+    const int rows = sizeof(tags) / sizeof(tags[0]);
+    const int row_height = (FONT_HEIGHT + 2) * OVERLAY_PIXEL;
+
+    SDL_Rect background = {0, 0, 10 * 5 * OVERLAY_PIXEL, rows * row_height + OVERLAY_PIXEL};
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderFillRect(renderer, &background);
+
+    for (int i = 0; i < rows; i++) {
+        char text[16];
+        snprintf(text, sizeof(text), "%-3s%ld", tags[i], values[i]);
+        draw_overlay_text(OVERLAY_PIXEL, OVERLAY_PIXEL + i * row_height, text);
     }
+}
 
+void render_frame(void) {
     SDL_Color color;
     for (size_t row = 0; row < DISPLAY_HEIGHT; row++) {
         for (size_t col = 0; col < DISPLAY_WIDTH; col++) {
@@ -314,9 +769,403 @@ void show_display(void) {
             draw_pixel(col, row, color);
         }
     }
+    if (overlay_on) { draw_overlay(); }
     SDL_RenderPresent(renderer);
 }
 
+void show_display(void) {
+    if (debug_info_on) {
+        puts("Updating display.");
+    }
+
+    render_frame();
+    metrics.frames_presented++;
+
+    if (latency_state == LATENCY_CHANGED) { latency_record_present(); }
+    if (recorder_thread != NULL) { recorder_push(RECORD_FRAME); }
+}
+
+void write_metrics(void) {
+    // Prometheus text format, written to a temp file and renamed into place
+    char temp_path[512];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", metrics_path);
+
+    FILE* file = fopen(temp_path, "w");
+    if (file == NULL) {
+        printf("Error: failed to write metrics to %s.\n", temp_path);
+        metrics_path = NULL;
+        return;
+    }
+
+    fprintf(file, "# TYPE chip8_instructions_total counter\nchip8_instructions_total %llu\n",
+        (unsigned long long)metrics.instructions);
+    fprintf(file, "# TYPE chip8_instructions_per_second gauge\nchip8_instructions_per_second %.1f\n", sample_ips);
+    fprintf(file, "# TYPE chip8_target_instructions_per_second gauge\nchip8_target_instructions_per_second %d\n",
+        PROCESSOR_FREQ);
+    fprintf(file, "# TYPE chip8_frames_presented_total counter\nchip8_frames_presented_total %llu\n",
+        (unsigned long long)metrics.frames_presented);
+    fprintf(file, "# TYPE chip8_frames_dropped_total counter\nchip8_frames_dropped_total %llu\n",
+        (unsigned long long)metrics.frames_dropped);
+    fprintf(file, "# TYPE chip8_timer_ticks_total counter\nchip8_timer_ticks_total %llu\n",
+        (unsigned long long)metrics.timer_ticks);
+    fprintf(file, "# TYPE chip8_timer_drift_ticks gauge\nchip8_timer_drift_ticks %.1f\n",
+        sample_drift);
+    fprintf(file, "# TYPE chip8_key_wait_seconds_total counter\nchip8_key_wait_seconds_total %.3f\n",
+        metrics.key_wait_ms / 1000.0);
+    fprintf(file, "# TYPE chip8_draws_total counter\nchip8_draws_total %llu\n",
+        (unsigned long long)metrics.draws);
+    fprintf(file, "# TYPE chip8_draws_per_frame_max gauge\nchip8_draws_per_frame_max %u\n", sample_draws_max);
+    fclose(file);
+
+    rename(temp_path, metrics_path);
+}
+
+void sample_metrics(Uint64 now) {
+    double seconds = (now - metrics_sample_time) / 1000.0;
+
+    // count an FX0A wait that is still in progress
+    if (key_waiting) {
+        metrics.key_wait_ms += now - key_wait_start;
+        key_wait_start = now;
+    }
+
+    sample_ips = (metrics.instructions - metrics_previous.instructions) / seconds;
+    sample_fps = (metrics.frames_presented - metrics_previous.frames_presented) / seconds;
+    sample_dropped = (metrics.frames_dropped - metrics_previous.frames_dropped) / seconds;
+    sample_draws_max = metrics.draws_per_frame_max;
+    sample_drift = metrics.timer_ticks - (now - metrics_start) / 1000.0 * TIMER_FREQ;
+    sample_key_wait = (metrics.key_wait_ms - metrics_previous.key_wait_ms) / seconds;
+
+    metrics.draws_per_frame_max = 0;
+    metrics_previous = metrics;
+    metrics_sample_time = now;
+
+    if (metrics_path != NULL) { write_metrics(); }
+    if (overlay_on) { render_frame(); }
+}
+
+void end_stall(Uint64 start) {
+    // the debugger console and file dialog block the loop; shift the metric
+    // baselines past the pause so it shows up as neither drift nor dropped frames
+    Uint64 stall = SDL_GetTicks64() - start;
+
+    metrics_start += stall;
+    metrics_sample_time += stall;
+    if (key_waiting) { key_wait_start += stall; }
+    loop_stalled = true;
+}
+
+bool parse_condition(const char* text, condition* cond) {
+    unsigned int reg;
+    long lo, hi;
+    char op[3];
+
+    cond->negate = false;
+    cond->was_true = false;
+
+    if (sscanf(text, " I in %li-%li", &lo, &hi) == 2) {
+        cond->kind = COND_INDEX_RANGE;
+        cond->lo = lo;
+        cond->hi = hi;
+        return true;
+    }
+    if (sscanf(text, " V%1x %2[=!] %li", &reg, op, &lo) == 3) {
+        cond->kind = COND_REGISTER;
+        cond->reg = reg;
+    } else if (sscanf(text, " DT %2[=!] %li", op, &lo) == 2) {
+        cond->kind = COND_DELAY_TIMER;
+    } else {
+        return false;
+    }
+
+    if (op[1] != '=') { return false; }
+    cond->negate = op[0] == '!';
+    cond->lo = lo;
+    return true;
+}
+
+bool condition_holds(const condition* cond) {
+    bool result;
+    switch (cond->kind) {
+        case COND_REGISTER:
+            result = registers[cond->reg] == cond->lo;
+            break;
+        case COND_DELAY_TIMER:
+            result = delay_timer == cond->lo;
+            break;
+        case COND_INDEX_RANGE:
+            result = index_register >= cond->lo && index_register <= cond->hi;
+            break;
+        default:
+            return true;
+    }
+    return result != cond->negate;
+}
+
+void check_global_conditions(void) {
+    for (size_t i = 0; i < global_condition_count; i++) {
+        bool now_true = condition_holds(&global_conditions[i]);
+        if (now_true && !global_conditions[i].was_true) {
+            printf("Condition %zu hit at %03x.\n", i, program_counter);
+            break_pending = true;
+        }
+        global_conditions[i].was_true = now_true;
+    }
+}
+
+void check_watch(unsigned short address, size_t length, unsigned char flag) {
+    // only called from memory opcodes, and only while watchpoint_count > 0
+    for (size_t i = 0; i < length; i++) {
+        unsigned short watched = (address + i) & (MEMORY_SIZE-1);
+        if (debug_flags[watched] & flag) {
+            printf("Watchpoint (%s) hit at %03x, PC %03x.\n",
+                flag == WATCH_READ ? "read" : "write", watched, program_counter - 2);
+            break_pending = true;
+            return;
+        }
+    }
+}
+
+void set_watch(unsigned short address, size_t length, unsigned char flags) {
+    for (size_t i = 0; i < length; i++) {
+        unsigned char* entry = &debug_flags[(address + i) & (MEMORY_SIZE-1)];
+        bool was_watched = *entry & (WATCH_READ | WATCH_WRITE);
+
+        *entry = (*entry & BREAK_EXEC) | flags;
+
+        bool is_watched = *entry & (WATCH_READ | WATCH_WRITE);
+        if (is_watched && !was_watched) { watchpoint_count++; }
+        if (!is_watched && was_watched) { watchpoint_count--; }
+    }
+}
+
+void print_registers(void) {
+    for (size_t i = 0; i < 16; i++) {
+        printf("V%zX=%02x ", i, registers[i]);
+        if (i % 8 == 7) { printf("\n"); }
+    }
+    printf("PC=%03x I=%03x DT=%02x ST=%02x SP=%d\n",
+        program_counter, index_register, delay_timer, sound_timer, top_of_stack);
+}
+
+void print_debugger_help(void) {
+    puts("b ADDR [if COND]      set breakpoint (COND: VX==NN, VX!=NN, DT==NN, I in LO-HI)");
+    puts("d ADDR                delete breakpoint");
+    puts("w ADDR [LEN] [r|w|rw] watch memory (default LEN 1, rw)");
+    puts("uw ADDR [LEN]         remove watch");
+    puts("cond COND | cond clear  break whenever COND becomes true");
+    puts("l                     list breakpoints, watchpoints and conditions");
+    puts("r                     show registers");
+    puts("s                     step one instruction");
+    puts("c                     continue");
+}
+
+void list_debug_points(void) {
+    for (size_t address = 0; address < MEMORY_SIZE; address++) {
+        if (debug_flags[address] & BREAK_EXEC) {
+            printf("break %03zx%s\n", address,
+                break_conditions[address].kind == COND_ALWAYS ? "" : " (conditional)");
+        }
+        if (debug_flags[address] & (WATCH_READ | WATCH_WRITE)) {
+            printf("watch %03zx %s%s\n", address,
+                debug_flags[address] & WATCH_READ ? "r" : "",
+                debug_flags[address] & WATCH_WRITE ? "w" : "");
+        }
+    }
+    printf("%zu condition(s)\n", global_condition_count);
+}
+
+bool parse_address(const char* text, unsigned short* address) {
+    char* end;
+    unsigned long parsed = strtoul(text, &end, 0);
+
+    if (end == text || *end != '\0' || parsed >= MEMORY_SIZE) {
+        puts("Error: invalid address.");
+        return false;
+    }
+    *address = parsed;
+    return true;
+}
+
+void debugger_console(void) {
+    // blocks the main loop; emulation resumes on 'c' or 's'
+    char line[128];
+
+    // drop any latency sample in flight, the pause would dominate it
+    latency_state = LATENCY_IDLE;
+
+    print_registers();
+    while (true) {
+        printf("(chip8 %03x) ", program_counter);
+        fflush(stdout);
+
+        if (fgets(line, sizeof(line), stdin) == NULL) {
+            // stdin closed, keep running
+            resume_past_break = true;
+            return;
+        }
+
+        char* command = strtok(line, " \t\n");
+        char* arg = strtok(NULL, " \t\n");
+        if (command == NULL) { continue; }
+
+        if (strcmp(command, "c") == 0) {
+            paused = false;
+            resume_past_break = true;
+            return;
+        } else if (strcmp(command, "s") == 0) {
+            step = true;
+            console_step = true;
+            resume_past_break = true;
+            return;
+        } else if (strcmp(command, "r") == 0) {
+            print_registers();
+        } else if (strcmp(command, "l") == 0) {
+            list_debug_points();
+        } else if (strcmp(command, "b") == 0 && arg != NULL) {
+            unsigned short address;
+            if (!parse_address(arg, &address)) { continue; }
+
+            char* keyword = strtok(NULL, " \t\n");
+            char* rest = strtok(NULL, "\n");
+
+            // parse into a copy so a typo keeps the existing breakpoint intact
+            condition cond = {0};
+            cond.kind = COND_ALWAYS;
+            if (keyword != NULL && (strcmp(keyword, "if") != 0 || rest == NULL
+                    || !parse_condition(rest, &cond))) {
+                puts("Error: invalid condition.");
+                continue;
+            }
+            break_conditions[address] = cond;
+            debug_flags[address] |= BREAK_EXEC;
+        } else if (strcmp(command, "d") == 0 && arg != NULL) {
+            unsigned short address;
+            if (!parse_address(arg, &address)) { continue; }
+
+            debug_flags[address] &= ~BREAK_EXEC;
+        } else if ((strcmp(command, "w") == 0 || strcmp(command, "uw") == 0) && arg != NULL) {
+            unsigned short address;
+            if (!parse_address(arg, &address)) { continue; }
+
+            char* length_arg = strtok(NULL, " \t\n");
+            char* mode = strtok(NULL, " \t\n");
+            size_t length = 1;
+
+            if (length_arg != NULL) {
+                char* end;
+                size_t parsed = strtoul(length_arg, &end, 0);
+
+                if (end == length_arg && mode == NULL) {
+                    // LEN omitted: "w ADDR MODE"
+                    mode = length_arg;
+                } else if (*end != '\0' || parsed == 0) {
+                    puts("Error: invalid length.");
+                    continue;
+                } else {
+                    length = parsed;
+                }
+            }
+
+            if (command[0] == 'w' && mode != NULL && (mode[0] == '\0' || mode[strspn(mode, "rw")] != '\0')) {
+                puts("Error: invalid mode, expected r, w or rw.");
+                continue;
+            }
+
+            unsigned char flags = 0;
+            if (command[0] == 'w') {
+                if (mode == NULL || strchr(mode, 'r')) { flags |= WATCH_READ; }
+                if (mode == NULL || strchr(mode, 'w')) { flags |= WATCH_WRITE; }
+            }
+            set_watch(address, length, flags);
+        } else if (strcmp(command, "cond") == 0 && arg != NULL) {
+            char* rest = strtok(NULL, "\n");
+
+            if (strcmp(arg, "clear") == 0) {
+                global_condition_count = 0;
+                continue;
+            }
+            if (global_condition_count == MAX_GLOBAL_CONDITIONS) {
+                puts("Error: too many conditions.");
+                continue;
+            }
+
+            // rejoin the expression split by strtok
+            char expression[128];
+            snprintf(expression, sizeof(expression), "%s %s", arg, rest != NULL ? rest : "");
+
+            condition* cond = &global_conditions[global_condition_count];
+            if (!parse_condition(expression, cond)) {
+                puts("Error: invalid condition.");
+                continue;
+            }
+            cond->was_true = condition_holds(cond);
+            global_condition_count++;
+        } else {
+            print_debugger_help();
+        }
+    }
+}
+
+void draw_op(unsigned char x, unsigned char y, unsigned char n) {
+    // DXYN - display/draw
+    metrics.draws++;
+    metrics.draws_this_frame++;
+
+    unsigned char x_coord = registers[x] & (DISPLAY_WIDTH-1);
+    unsigned char y_coord = registers[y] & (DISPLAY_HEIGHT-1);
+
+    if (watchpoint_count > 0) { check_watch(index_register, n, WATCH_READ); }
+
+    draw_sprite(x_coord, y_coord, n);
+    show_display();
+}
+
+void store_bcd_op(unsigned char x) {
+    // FX33 - BCD
+    unsigned char value = registers[x];
+
+    if (watchpoint_count > 0) { check_watch(index_register, 3, WATCH_WRITE); }
+
+    memory[index_register] = value/100;
+    memory[index_register+1] = (value/10) % 10;
+    memory[index_register+2] = value % 10;
+
+    refuse_range(index_register, 3);
+}
+
+void store_memory_op(unsigned char x) {
+    // FX55 - store memory
+    unsigned short start = index_register;
+
+    if (watchpoint_count > 0) { check_watch(index_register, x + 1, WATCH_WRITE); }
+
+    for (size_t i = 0; i <= x; i++) {
+        if (modern_flag) {
+            memory[index_register+i] = registers[i];
+        } else {
+            memory[index_register] = registers[i];
+            index_register++;
+        }
+    }
+
+    refuse_range(start, x + 1);
+}
+
+void load_memory_op(unsigned char x) {
+    // FX65 - load memory
+    if (watchpoint_count > 0) { check_watch(index_register, x + 1, WATCH_READ); }
+
+    for (size_t i = 0; i <= x; i++) {
+        if (modern_flag) {
+            registers[i] = memory[index_register+i];
+        } else {
+            registers[i] = memory[index_register];
+            index_register++;
+        }
+    }
+}
+
 void process_instruction(void) {
     // fetch
     unsigned char instruction_byte1 = memory[program_counter];
@@ -350,7 +1199,7 @@ void process_instruction(void) {
                 switch (nibble4) {
                     case 0x0:
                         // 00E0 - clear screen
-                        clear_display();
+                        if (clear_display()) { latency_frame_changed(); }
                         show_display();
                         break;
                     case 0xE:
@@ -506,23 +1355,24 @@ void process_instruction(void) {
         }
         case 0xD: {
             // DXYN - display/draw
-            unsigned char x_coord = registers[nibble2] & (DISPLAY_WIDTH-1);
-            unsigned char y_coord = registers[nibble3] & (DISPLAY_HEIGHT-1);
-            unsigned char n_height = nibble4;
-
-            draw_sprite(x_coord, y_coord, n_height);
-            show_display();
+            draw_op(nibble2, nibble3, nibble4);
             break;
         }
         case 0xE: {
             switch (instruction_byte2) {
                 case 0x9E: {
                     // EX9E - skip if VX pressed
+                    if (latency_state == LATENCY_EVENT && registers[nibble2] == latency_key) {
+                        latency_advance(LATENCY_OBSERVED);
+                    }
                     if (keypad_state[registers[nibble2]]) { program_counter += 2; }
                     break;
                 }
                 case 0xA1: {
                     // EXA1 - skip if VX not pressed
+                    if (latency_state == LATENCY_EVENT && registers[nibble2] == latency_key) {
+                        latency_advance(LATENCY_OBSERVED);
+                    }
                     if (!keypad_state[registers[nibble2]]) { program_counter += 2; }
                     break;
                 }
@@ -544,6 +1394,11 @@ void process_instruction(void) {
                 case 0x18: {
                     // FX18 - set sound timer to VX
                     sound_timer = registers[nibble2];
+
+                    if (recorder_thread != NULL && sound_timer > 0 && !recorder_beeping) {
+                        recorder_beeping = true;
+                        recorder_push(RECORD_BEEP_ON);
+                    }
                     break;
                 }
                 case 0x1E: {
@@ -571,13 +1426,26 @@ void process_instruction(void) {
                         if (keypad_state[key]) {
                             registers[nibble2] = key;
                             pressed = true;
+
+                            if (latency_state == LATENCY_EVENT && key == latency_key) {
+                                latency_advance(LATENCY_OBSERVED);
+                            }
                             break;
                         }
                     }
                     if (debug_info_on) {
                         printf("\n");
                     }
-                    if (!pressed) { program_counter -= 2; }
+                    if (!pressed) {
+                        program_counter -= 2;
+                        if (!key_waiting) {
+                            key_waiting = true;
+                            key_wait_start = SDL_GetTicks64();
+                        }
+                    } else if (key_waiting) {
+                        key_waiting = false;
+                        metrics.key_wait_ms += SDL_GetTicks64() - key_wait_start;
+                    }
                     break;
                 }
                 case 0x29: {
@@ -587,35 +1455,17 @@ void process_instruction(void) {
                 }
                 case 0x33: {
                     // FX33 - BCD
-                    unsigned char value = registers[nibble2];
-
-                    memory[index_register] = value/100;
-                    memory[index_register+1] = (value/10) % 10;
-                    memory[index_register+2] = value % 10;
+                    store_bcd_op(nibble2);
                     break;
                 }
                 case 0x55: {
                     // FX55 - store memory
-                    for (size_t i = 0; i <= nibble2; i++) {
-                        if (modern_flag) {
-                            memory[index_register+i] = registers[i];
-                        } else {
-                            memory[index_register] = registers[i];
-                            index_register++;
-                        }
-                    }
+                    store_memory_op(nibble2);
                     break;
                 }
                 case 0x65: {
                     // FX65 - load memory
-                    for (size_t i = 0; i <= nibble2; i++) {
-                        if (modern_flag) {
-                            registers[i] = memory[index_register+i];
-                        } else {
-                            registers[i] = memory[index_register];
-                            index_register++;
-                        }
-                    }
+                    load_memory_op(nibble2);
                     break;
                 }
             }
@@ -630,6 +1480,74 @@ void process_instruction(void) {
     }
 }
 
+bool can_fuse(void) {
+    // fused sequences skip per-instruction tracing, stepping, interior breakpoints
+    // and would stop one instruction late on a watchpoint hit
+    if (!fusion_on || debug_info_on || step || global_condition_count > 0 || watchpoint_count > 0) {
+        return false;
+    }
+
+    for (size_t i = 2; i < MAX_FUSED_SPAN; i += 2) {
+        if (debug_flags[(program_counter + i) & (MEMORY_SIZE-1)] & BREAK_EXEC) { return false; }
+    }
+    return true;
+}
+
+unsigned char execute_fused(void) {
+    // returns the number of CHIP-8 instructions executed
+    unsigned short start = program_counter;
+    fused_kind kind = fused_ops[start];
+    unsigned char x = memory[start] & 0xF;
+    unsigned char byte2 = memory[start+1];
+
+    program_counter = start + 2;
+
+    switch (kind) {
+        case FUSED_TIMER_WAIT: {
+            // FX07; 3XNN/4XNN; 1NNN
+            registers[x] = delay_timer;
+
+            bool equal = registers[x] == memory[start+3];
+            bool skip = (memory[start+2] >> 4) == 0x3 ? equal : !equal;
+            if (skip) {
+                program_counter = start + 6;
+                return 2;
+            }
+            program_counter = ((memory[start+4] & 0xF) << 8) + memory[start+5];
+            return 3;
+        }
+        case FUSED_SPRITE: {
+            // ANNN; DXYN
+            index_register = (x << 8) + byte2;
+            program_counter = start + 4;
+            draw_op(memory[start+2] & 0xF, memory[start+3] >> 4, memory[start+3] & 0xF);
+            return 2;
+        }
+        case FUSED_SET_PAIR: {
+            // 6XNN; 6YNN
+            registers[x] = byte2;
+            registers[memory[start+2] & 0xF] = memory[start+3];
+            program_counter = start + 4;
+            return 2;
+        }
+        case FUSED_BCD_LOAD: {
+            // FX33; FY65
+            store_bcd_op(x);
+
+            // the BCD write landed on the FY65, run whatever is there now normally
+            if (fused_ops[start] != FUSED_BCD_LOAD) { return 1; }
+
+            program_counter = start + 4;
+            load_memory_op(memory[start+2] & 0xF);
+            return 2;
+        }
+        default:
+            program_counter = start;
+            process_instruction();
+            return 1;
+    }
+}
+
 void handle_keypad() {
     const Uint8* keyboard = SDL_GetKeyboardState(NULL);
 
@@ -675,9 +1593,12 @@ void handle_keyevents(SDL_KeyboardEvent* event) {
                     paused = true;
                     step = true;
                     break;
-                case SDL_SCANCODE_O:
+                case SDL_SCANCODE_O: {
+                    Uint64 stall_start = SDL_GetTicks64();
                     reset();
+                    end_stall(stall_start);
                     break;
+                }
                 case SDL_SCANCODE_M:
                     printf("Modern: %d -> %d\n", modern_flag, !modern_flag);
                     modern_flag = !modern_flag;
@@ -685,6 +1606,33 @@ void handle_keyevents(SDL_KeyboardEvent* event) {
                 case SDL_SCANCODE_I:
                     debug_info_on = !debug_info_on;
                     break;
+                case SDL_SCANCODE_B:
+                    break_pending = true;
+                    break;
+                case SDL_SCANCODE_L:
+                    if (latency_tracking_on) { print_latency_report(); }
+                    printf("Latency tracking: %d -> %d\n", latency_tracking_on, !latency_tracking_on);
+                    latency_tracking_on = !latency_tracking_on;
+                    latency_state = LATENCY_IDLE;
+
+                    // each session starts with empty histograms
+                    if (latency_tracking_on) {
+                        memset(latency_histogram, 0, sizeof(latency_histogram));
+                        memset(latency_max, 0, sizeof(latency_max));
+                    }
+                    break;
+                case SDL_SCANCODE_U:
+                    printf("Fusion: %d -> %d\n", fusion_on, !fusion_on);
+                    fusion_on = !fusion_on;
+                    break;
+                case SDL_SCANCODE_H:
+                    overlay_on = !overlay_on;
+                    render_frame();
+                    break;
+                case SDL_SCANCODE_T:
+                    if (recorder_thread != NULL) { stop_recording(); }
+                    else { start_recording(); }
+                    break;
                 default:
                     break;
             }
@@ -693,6 +1641,15 @@ void handle_keyevents(SDL_KeyboardEvent* event) {
     }
 
     handle_keypad();
+
+    if (event->type == SDL_KEYDOWN && !event->repeat) {
+        for (size_t i = 0; i < 16; i++) {
+            if (event->keysym.scancode == keypad_map[i]) {
+                latency_key_event(KEYPAD_KEYS[i]);
+                break;
+            }
+        }
+    }
 }
 
 void run(void) {
@@ -725,19 +1682,78 @@ void run(void) {
         if (now - last_processor >= PROCESSING_INTERVAL) {
             last_processor = now;
 
-            if (!paused || step) {
-                process_instruction();
-                step = false;
+            if (pending_cycles > 0) {
+                // a fused sequence already ran the instructions for this slot
+                pending_cycles--;
+            } else if (!paused || step) {
+                if (!resume_past_break && (debug_flags[program_counter] & BREAK_EXEC)
+                        && condition_holds(&break_conditions[program_counter])) {
+                    printf("Breakpoint hit at %03x.\n", program_counter);
+                    Uint64 stall_start = SDL_GetTicks64();
+                    debugger_console();
+                    end_stall(stall_start);
+                } else {
+                    resume_past_break = false;
+                    if (fused_ops[program_counter] != FUSED_NONE && can_fuse()) {
+                        unsigned char executed = execute_fused();
+                        pending_cycles = executed - 1;
+                        metrics.instructions += executed;
+                    } else {
+                        process_instruction();
+                        metrics.instructions++;
+                    }
+                    step = false;
+
+                    if (global_condition_count > 0) { check_global_conditions(); }
+                    if (console_step) {
+                        console_step = false;
+                        break_pending = true;
+                    }
+                }
+            }
+
+            if (break_pending) {
+                break_pending = false;
+                Uint64 stall_start = SDL_GetTicks64();
+                debugger_console();
+                end_stall(stall_start);
             }
         }
         
+        if (loop_stalled) {
+            // restart the 60hz schedule instead of counting the pause as dropped
+            // ticks; now is stale, so skip to the next iteration
+            loop_stalled = false;
+            last_display = SDL_GetTicks64();
+            continue;
+        }
+
         // display timer
         if (now - last_display >= TIMER_INTERVAL) {
+            Uint64 elapsed_ticks = (now - last_display) / TIMER_INTERVAL;
+            if (elapsed_ticks > 1) { metrics.frames_dropped += elapsed_ticks - 1; }
             last_display = now;
 
+            metrics.timer_ticks++;
+            if (metrics.draws_this_frame > metrics.draws_per_frame_max) {
+                metrics.draws_per_frame_max = metrics.draws_this_frame;
+            }
+            metrics.draws_this_frame = 0;
+
             // decrement timers
             if (delay_timer > 0) { delay_timer--; }
             if (sound_timer > 0) { sound_timer--; }
+
+            // the beep starts in FX18, it can only end here
+            if (recorder_thread != NULL && recorder_beeping && sound_timer == 0) {
+                recorder_beeping = false;
+                recorder_push(RECORD_BEEP_OFF);
+            }
+        }
+
+        // metrics sample
+        if (now - metrics_sample_time >= METRICS_INTERVAL) {
+            sample_metrics(now);
         }
     }
 }
@@ -748,6 +1764,8 @@ int main(void) {
 
     run();
 
+    if (latency_tracking_on) { print_latency_report(); }
+
     dispose();
 
     return 0;